@@ -1,9 +1,18 @@
 #ifndef _LWIPOPTS_H
 #define _LWIPOPTS_H
 
+// This defaults to 256. Must hold the largest payload plus topic and headers
+#define MQTT_OUTPUT_RINGBUF_SIZE 512
+
+// mqtt_client_new() allocates the client, output ring included, from the lwIP heap:
+// grow the heap by what the ring grew so TCP keeps the same room
+#define MQTT_RINGBUF_HEAP_EXTRA (MQTT_OUTPUT_RINGBUF_SIZE - 256)
+
 // Need more memory for TLS
 #ifdef MQTT_CERT_INC
-#define MEM_SIZE 8000
+#define MEM_SIZE (8000 + MQTT_RINGBUF_HEAP_EXTRA)
+#else
+#define MEM_SIZE (4000 + MQTT_RINGBUF_HEAP_EXTRA)
 #endif
 
 // Generally you would define your own explicit list of lwIP options
@@ -30,4 +39,18 @@
 // This defaults to 4
 #define MQTT_REQ_MAX_IN_FLIGHT 5
 
+// The common include disables heap and memp statistics. Turn them on for the high-water
+// mark report in debug builds, and force them on for the load benchmark in any build
+// (MQTT_BENCHMARK must be a target compile definition so lwIP sees it too)
+#if MQTT_BENCHMARK
+#undef LWIP_STATS
+#define LWIP_STATS 1
+#endif
+#if LWIP_STATS
+#undef MEM_STATS
+#define MEM_STATS 1
+#undef MEMP_STATS
+#define MEMP_STATS 1
+#endif
+
 #endif
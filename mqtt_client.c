@@ -9,16 +9,31 @@
 #include "pico/cyw43_arch.h"        // Biblioteca para Wi-Fi da Pico com CYW43
 #include "pico/unique_id.h"         // Biblioteca para identificador único da placa
 #include <math.h>                   // Biblioteca para funções matemáticas (fabs)
+#include <stdarg.h>                 // Argumentos variáveis (payload_append)
 
 #include "hardware/gpio.h"          // Biblioteca de hardware de GPIO
 #include "hardware/irq.h"           // Biblioteca de interrupções
 #include "hardware/adc.h"           // Biblioteca para conversão ADC
 #include "hardware/pwm.h"           // Biblioteca para PWM
+#include "hardware/clocks.h"        // Biblioteca para controle de clock
 
 #include "lwip/apps/mqtt.h"         // Biblioteca LWIP MQTT
 #include "lwip/apps/mqtt_priv.h"    // Funções para conexões MQTT
 #include "lwip/dns.h"               // Suporte DNS
 #include "lwip/altcp_tls.h"         // Conexões seguras com TLS
+#include "lwip/stats.h"             // Estatísticas de memória do lwIP
+#include "lwip/memp.h"              // Pools estáticos do lwIP (orçamento de memória)
+#include "lwip/priv/memp_priv.h"    // MEMP_SIZE e MEMP_ALIGN_SIZE
+#include "lwip/raw.h"               // Estruturas dos pools memp: raw_pcb
+#include "lwip/udp.h"               // udp_pcb
+#include "lwip/tcp.h"               // tcp_pcb, tcp_pcb_listen
+#include "lwip/priv/tcp_priv.h"     // tcp_seg
+#include "lwip/altcp.h"             // altcp_pcb
+#include "lwip/ip4_frag.h"          // ip_reassdata, pbuf_custom_ref
+#include "lwip/etharp.h"            // etharp_q_entry
+#include "lwip/igmp.h"              // igmp_group
+#include "lwip/timeouts.h"          // sys_timeo
+#include "sample_codec.h"           // Codec compacto para lotes de amostras
 
 #define WIFI_SSID "TIM_ULTRAFIBRA_28A0"                  // Substitua pelo nome da sua rede Wi-Fi
 #define WIFI_PASSWORD "64t4fu76eb"      // Substitua pela senha da sua rede Wi-Fi
@@ -44,11 +59,39 @@
 #define MQTT_TOPIC_LEN 100
 #endif
 
+#ifndef MQTT_INPUT_DATA_LEN
+#define MQTT_INPUT_DATA_LEN 128 // Maior mensagem recebida tratada (/led, /print, ...)
+#endif
+
+#ifndef PAYLOAD_BUF_SIZE
+#define PAYLOAD_BUF_SIZE 256 // Maior payload publicado (bytes)
+#endif
+
+// Cabeçalho fixo (até 5 bytes), tamanho do tópico (2) e packet id (2) de um PUBLISH
+#define MQTT_PUBLISH_OVERHEAD (5 + 2 + 2)
+_Static_assert(PAYLOAD_BUF_SIZE + MQTT_TOPIC_LEN + MQTT_PUBLISH_OVERHEAD <= MQTT_OUTPUT_RINGBUF_SIZE,
+               "MQTT_OUTPUT_RINGBUF_SIZE too small for a full payload");
+
+// Buffer estático único onde os payloads são formatados; o mqtt_publish() os copia
+// para o ring de saída do cliente, que é o único buffer que permanece até o envio
+typedef struct {
+    uint16_t len;
+    bool overflow; // Alguma escrita não coube no buffer
+    char data[PAYLOAD_BUF_SIZE];
+} PAYLOAD_T;
+
+// Ocupação da saída do cliente MQTT, medida após cada publicação
+typedef struct {
+    uint16_t ring_max;   // Máximo de bytes pendentes no ring de saída
+    uint8_t req_max;     // Máximo de requisições aguardando resposta
+    uint32_t mem_errors; // Publicações recusadas com ERR_MEM
+} MQTT_OUTPUT_STATS_T;
+
 // Dados do cliente MQTT
 typedef struct {
     mqtt_client_t* mqtt_client_inst;
     struct mqtt_connect_client_info_t mqtt_client_info;
-    char data[MQTT_OUTPUT_RINGBUF_SIZE];
+    char data[MQTT_INPUT_DATA_LEN];
     char topic[MQTT_TOPIC_LEN];
     uint32_t len;
     ip_addr_t mqtt_server_address;
@@ -56,6 +99,8 @@ typedef struct {
     int subscribe_count;
     bool stop_client;
     bool led_state; // Estado atual do LED
+    uint32_t radio_pm; // Modo de economia de energia atual do CYW43
+    int batch_in_flight; // Envios em lote aguardando confirmação
 } MQTT_CLIENT_DATA_T;
 
 #ifndef DEBUG_printf
@@ -93,6 +138,116 @@ typedef struct {
 #define BUZZER_DUTY_CYCLE 50   // Ciclo de trabalho do PWM (50%)
 #define BUZZER_INTERVAL_MS 500 // Intervalo intermitente (500 ms ligado/desligado)
 
+// Canais de cada amostra acumulada
+#define SAMPLE_CHANNEL_PRESSURE 0
+#define SAMPLE_CHANNEL_GAS 1
+#define SAMPLE_CHANNELS 2
+
+// Modo de baixo consumo: amostras acumuladas em lote, Wi-Fi em power-save e clock reduzido
+#ifndef LOW_POWER_MODE
+#define LOW_POWER_MODE 0
+#endif
+#ifndef LOW_POWER_SYS_CLOCK_KHZ
+#define LOW_POWER_SYS_CLOCK_KHZ 48000 // Clock do sistema no modo de baixo consumo
+#endif
+#ifndef LOW_POWER_BATCH_SAMPLES
+#define LOW_POWER_BATCH_SAMPLES 8 // Amostras por envio em lote (latência = amostras x período)
+#endif
+#ifndef LOW_POWER_DTIM_PERIOD
+#define LOW_POWER_DTIM_PERIOD 3 // Intervalos DTIM entre escutas do rádio em power-save
+#endif
+#define LOW_POWER_WIFI_PM cyw43_pm_value(CYW43_PM1_POWERSAVE_MODE, 10, 1, LOW_POWER_DTIM_PERIOD, 10)
+#define UPLOAD_WIFI_PM CYW43_NONE_PM // Rádio sempre acordado durante o envio do lote
+#define MQTT_BATCH_TOPIC "/batch"
+#ifndef LOW_POWER_BATCH_CODEC
+#define LOW_POWER_BATCH_CODEC 1 // 1 = lote em binário (sample_codec.h), 0 = texto
+#endif
+#if LOW_POWER_BATCH_CODEC
+_Static_assert(SAMPLE_CODEC_MAX_SIZE(LOW_POWER_BATCH_SAMPLES, SAMPLE_CHANNELS) <= PAYLOAD_BUF_SIZE,
+               "LOW_POWER_BATCH_SAMPLES does not fit in PAYLOAD_BUF_SIZE");
+#else
+#define BATCH_SAMPLE_MAX_LEN 28 // ";dt,pressão,gás" no pior caso
+_Static_assert(16 + LOW_POWER_BATCH_SAMPLES * BATCH_SAMPLE_MAX_LEN <= PAYLOAD_BUF_SIZE,
+               "LOW_POWER_BATCH_SAMPLES does not fit in PAYLOAD_BUF_SIZE");
+#endif
+
+// Benchmark de carga contínua: publica sem parar para medir vazão e uso de memória
+#ifndef MQTT_BENCHMARK
+#define MQTT_BENCHMARK 0
+#endif
+#define MQTT_BENCH_TOPIC "/bench"
+#ifndef MQTT_BENCH_QOS
+#define MQTT_BENCH_QOS 0
+#endif
+#define MQTT_BENCH_INTERVAL_MS 10   // Intervalo entre rajadas
+#define MQTT_BENCH_BURST 4          // Publicações por rajada
+#define MQTT_BENCH_PAYLOAD_LEN 200  // Tamanho aproximado de cada payload
+#define MQTT_BENCH_REPORT_MS 5000   // Intervalo entre relatórios
+
+// Orçamento estático de memória de rede, verificado em tempo de compilação.
+// O mqtt_client_new() aloca o cliente (ring de saída incluso) no heap do lwIP, por isso
+// ele é contado como parte de MEM_SIZE e não somado ao total
+#define MEMORY_BUDGET_LWIP_HEAP   (LWIP_MEM_ALIGN_SIZE(MEM_SIZE) + MEM_ALIGNMENT)
+#define MEMORY_BUDGET_MQTT_CLIENT sizeof(mqtt_client_t)
+#define MEMORY_BUDGET_PBUF_BLOCK  (LWIP_MEM_ALIGN_SIZE(sizeof(struct pbuf)) + LWIP_MEM_ALIGN_SIZE(PBUF_POOL_BUFSIZE))
+#define MEMORY_BUDGET_TCP_SEG     MEMP_ALIGN_SIZE(sizeof(struct tcp_seg))
+#define MEMORY_BUDGET_PAYLOAD     sizeof(PAYLOAD_T)
+
+// Soma de todos os pools memp habilitados neste build (PCBs, segmentos TCP, timeouts,
+// pbufs...), percorrendo a mesma tabela memp_std.h com que o memp.c declara cada pool
+enum {
+    MEMORY_BUDGET_MEMP = 0
+#define LWIP_MEMPOOL(name, num, size, desc) + (num) * (MEMP_SIZE + MEMP_ALIGN_SIZE(size)) + (MEM_ALIGNMENT - 1)
+#include "lwip/priv/memp_std.h"
+};
+
+#define MEMORY_BUDGET_TOTAL       (MEMORY_BUDGET_LWIP_HEAP + MEMORY_BUDGET_MEMP + \
+                                   MEMORY_BUDGET_PAYLOAD + MQTT_INPUT_DATA_LEN)
+_Static_assert(MEMORY_BUDGET_MQTT_CLIENT < MEMORY_BUDGET_LWIP_HEAP, "MEM_SIZE too small for the MQTT client");
+#ifdef MEMORY_BUDGET_LIMIT
+_Static_assert(MEMORY_BUDGET_TOTAL <= MEMORY_BUDGET_LIMIT, "network memory budget exceeded");
+#endif
+
+// Corrente média por fase (uA) e tensão de alimentação (mV) usadas na contabilização de energia.
+// Valores típicos do Pico W; substitua pelos medidos com amperímetro na sua placa.
+#ifndef POWER_SLEEP_UA
+#define POWER_SLEEP_UA 18000   // CPU ociosa, rádio em LOW_POWER_WIFI_PM
+#endif
+#ifndef POWER_ACTIVE_UA
+#define POWER_ACTIVE_UA 32000  // CPU executando aquisição/formatação
+#endif
+#ifndef POWER_IDLE_UA
+#define POWER_IDLE_UA 28000    // CPU ociosa, rádio em CYW43_DEFAULT_PM (PM2)
+#endif
+#ifndef POWER_RADIO_UA
+#define POWER_RADIO_UA 45000   // CPU ociosa, rádio sem power-save (UPLOAD_WIFI_PM)
+#endif
+#ifndef POWER_SUPPLY_MV
+#define POWER_SUPPLY_MV 3700   // Tensão da bateria em VSYS
+#endif
+#ifndef POWER_REPORT_SAMPLES
+#define POWER_REPORT_SAMPLES 30 // Amostras entre relatórios de energia
+#endif
+
+// Fases de consumo contabilizadas
+typedef enum {
+    POWER_PHASE_SLEEP,
+    POWER_PHASE_ACTIVE,
+    POWER_PHASE_IDLE,
+    POWER_PHASE_RADIO,
+    POWER_PHASE_COUNT
+} power_phase_t;
+
+typedef struct {
+    power_phase_t phase;
+    uint64_t phase_start_us;
+    uint64_t phase_us[POWER_PHASE_COUNT];
+    uint32_t samples;
+} POWER_STATS_T;
+
+// Amostra bruta do ADC armazenada até o próximo envio em lote
+typedef codec_sample_t SAMPLE_T;
+
 static float read_onboard_pressure(const char unit);
 static float read_onboard_gas(const char unit);
 static void pub_request_cb(__unused void *arg, err_t err);
@@ -112,10 +267,48 @@ static async_at_time_worker_t gas_worker = { .do_work = gas_worker_fn };
 static void mqtt_connection_cb(mqtt_client_t *client, void *arg, mqtt_connection_status_t status);
 static void start_client(MQTT_CLIENT_DATA_T *state);
 static void dns_found(const char *hostname, const ip_addr_t *ipaddr, void *arg);
+static void buzzer_init(void);
+static void power_phase_enter(power_phase_t phase);
+static void power_phase_idle(MQTT_CLIENT_DATA_T *state);
+static void power_sample_done(void);
+static void power_report(void);
+static PAYLOAD_T *payload_begin(void);
+static bool payload_append(PAYLOAD_T *payload, const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+static err_t publish_payload(MQTT_CLIENT_DATA_T *state, const char *topic, const PAYLOAD_T *payload, u8_t qos,
+                             mqtt_request_cb_t cb);
+static void mqtt_output_sample(MQTT_CLIENT_DATA_T *state);
+static void memory_budget_report(void);
+static void memory_report(void);
+#if MQTT_BENCHMARK
+static void bench_worker_fn(async_context_t *context, async_at_time_worker_t *worker);
+static async_at_time_worker_t bench_worker = { .do_work = bench_worker_fn };
+#endif
+#if LOW_POWER_MODE
+static void radio_wake(MQTT_CLIENT_DATA_T *state);
+static void radio_sleep(MQTT_CLIENT_DATA_T *state);
+static void flush_batch(MQTT_CLIENT_DATA_T *state);
+static void batch_pub_cb(void *arg, err_t err);
+static void sample_worker_fn(async_context_t *context, async_at_time_worker_t *worker);
+static async_at_time_worker_t sample_worker = { .do_work = sample_worker_fn };
+#endif
+
+static POWER_STATS_T power_stats;
+static PAYLOAD_T payload_buf;
+static MQTT_OUTPUT_STATS_T mqtt_output_stats;
+static uint16_t buzzer_wrap;
+#if LOW_POWER_MODE
+static SAMPLE_T batch[LOW_POWER_BATCH_SAMPLES];
+static int batch_count;
+#endif
 
 int main(void) {
+#if LOW_POWER_MODE
+    // Reduz o clock antes de inicializar periféricos que dependem dele
+    set_sys_clock_khz(LOW_POWER_SYS_CLOCK_KHZ, true);
+#endif
     stdio_init_all();
     INFO_printf("mqtt client starting\n");
+    memory_budget_report();
 
     adc_init();
     adc_gpio_init(EIXO_Y);
@@ -127,18 +320,11 @@ int main(void) {
     gpio_disable_pulls(LED_PIN); // Desativa pull-up/pull-down
     gpio_put(LED_PIN, 0); // LED inicialmente desligado
 
-    // Inicializa o pino do buzzer com PWM
-    gpio_set_function(BUZZER_PIN, GPIO_FUNC_PWM);
-    uint slice_num = pwm_gpio_to_slice_num(BUZZER_PIN);
-    pwm_config config = pwm_get_default_config();
-    // Configura a frequência do PWM (~1000 Hz)
-    float divider = 125000000.0f / (BUZZER_FREQ * 65535); // Clock do Pico = 125 MHz
-    pwm_config_set_clkdiv(&config, divider);
-    pwm_config_set_wrap(&config, 65535); // Resolução de 16 bits
-    pwm_init(slice_num, &config, true);
-    pwm_set_gpio_level(BUZZER_PIN, 0); // Buzzer inicialmente desligado
+    buzzer_init();
 
-    static MQTT_CLIENT_DATA_T state = { .led_state = false }; // Inicializa LED como desligado
+    static MQTT_CLIENT_DATA_T state = { .led_state = false, .radio_pm = CYW43_DEFAULT_PM }; // Inicializa LED como desligado
+    power_stats.phase = POWER_PHASE_IDLE;
+    power_stats.phase_start_us = time_us_64();
 
     if (cyw43_arch_init()) {
         panic("Failed to initialize CYW43");
@@ -193,6 +379,10 @@ int main(void) {
         panic("Failed to connect");
     }
     INFO_printf("\nConnected to Wifi\n");
+#if LOW_POWER_MODE
+    INFO_printf("Low power mode: sys clock %u kHz, batch of %d samples\n",
+                clock_get_hz(clk_sys) / 1000, LOW_POWER_BATCH_SAMPLES);
+#endif
 
     cyw43_arch_lwip_begin();
     int err = dns_gethostbyname(MQTT_SERVER, &state.mqtt_server_address, dns_found, &state);
@@ -213,6 +403,147 @@ int main(void) {
     return 0;
 }
 
+static void buzzer_init(void) {
+    // Inicializa o pino do buzzer com PWM
+    gpio_set_function(BUZZER_PIN, GPIO_FUNC_PWM);
+    uint slice_num = pwm_gpio_to_slice_num(BUZZER_PIN);
+    pwm_config config = pwm_get_default_config();
+    // Configura a frequência do PWM (~1000 Hz) a partir do clock atual do sistema,
+    // usando resolução de 16 bits quando possível
+    uint32_t ticks = clock_get_hz(clk_sys) / BUZZER_FREQ;
+    float divider = ticks > 65536 ? ticks / 65536.0f : 1.0f;
+    buzzer_wrap = (uint16_t)(ticks / divider - 1);
+    pwm_config_set_clkdiv(&config, divider);
+    pwm_config_set_wrap(&config, buzzer_wrap);
+    pwm_init(slice_num, &config, true);
+    pwm_set_gpio_level(BUZZER_PIN, 0); // Buzzer inicialmente desligado
+}
+
+static void power_phase_enter(power_phase_t phase) {
+    uint64_t now = time_us_64();
+    power_stats.phase_us[power_stats.phase] += now - power_stats.phase_start_us;
+    power_stats.phase_start_us = now;
+    power_stats.phase = phase;
+}
+
+// Volta à fase ociosa correspondente ao modo de economia de energia do rádio
+static void power_phase_idle(MQTT_CLIENT_DATA_T *state) {
+    if (state->radio_pm == CYW43_DEFAULT_PM) {
+        power_phase_enter(POWER_PHASE_IDLE);
+    } else if (state->radio_pm == CYW43_NONE_PM) {
+        power_phase_enter(POWER_PHASE_RADIO);
+    } else {
+        power_phase_enter(POWER_PHASE_SLEEP);
+    }
+}
+
+static void power_sample_done(void) {
+    power_stats.samples++;
+    if (power_stats.samples % POWER_REPORT_SAMPLES == 0) {
+        power_report();
+        memory_report();
+    }
+}
+
+static void power_report(void) {
+    static const uint32_t phase_ua[POWER_PHASE_COUNT] = { POWER_SLEEP_UA, POWER_ACTIVE_UA, POWER_IDLE_UA, POWER_RADIO_UA };
+    power_phase_enter(power_stats.phase); // Contabiliza o tempo da fase atual
+    float energy_mj = 0.0f;
+    for (int i = 0; i < POWER_PHASE_COUNT; i++) {
+        // us * uA * mV = 1e-15 J
+        energy_mj += (float)power_stats.phase_us[i] * phase_ua[i] * POWER_SUPPLY_MV / 1e12f;
+    }
+    INFO_printf("Power: sleep=%llums active=%llums idle=%llums radio=%llums, energy=%.1fmJ, %.2fmJ/sample (%u samples)\n",
+                power_stats.phase_us[POWER_PHASE_SLEEP] / 1000, power_stats.phase_us[POWER_PHASE_ACTIVE] / 1000,
+                power_stats.phase_us[POWER_PHASE_IDLE] / 1000, power_stats.phase_us[POWER_PHASE_RADIO] / 1000, energy_mj,
+                power_stats.samples ? energy_mj / power_stats.samples : 0.0f, power_stats.samples);
+}
+
+// Reinicia o buffer de payload; só é usado a partir do contexto assíncrono do CYW43
+static PAYLOAD_T *payload_begin(void) {
+    payload_buf.len = 0;
+    payload_buf.overflow = false;
+    payload_buf.data[0] = '\0';
+    return &payload_buf;
+}
+
+// Formata no final do buffer; em caso de estouro a escrita é descartada
+static bool payload_append(PAYLOAD_T *payload, const char *fmt, ...) {
+    size_t room = sizeof(payload->data) - payload->len;
+    va_list args;
+    va_start(args, fmt);
+    int n = vsnprintf(payload->data + payload->len, room, fmt, args);
+    va_end(args);
+    if (n < 0 || (size_t)n >= room) {
+        payload->data[payload->len] = '\0';
+        payload->overflow = true;
+        return false;
+    }
+    payload->len += n;
+    return true;
+}
+
+static err_t publish_payload(MQTT_CLIENT_DATA_T *state, const char *topic, const PAYLOAD_T *payload, u8_t qos,
+                             mqtt_request_cb_t cb) {
+    err_t err = mqtt_publish(state->mqtt_client_inst, topic, payload->data, payload->len,
+                             qos, MQTT_PUBLISH_RETAIN, cb, state);
+    if (err == ERR_MEM) {
+        mqtt_output_stats.mem_errors++;
+    }
+    mqtt_output_sample(state);
+    return err;
+}
+
+// O ERR_MEM do mqtt_publish() vem do ring de saída ou da lista de requisições cheios:
+// registra o máximo de ocupação de cada um
+static void mqtt_output_sample(MQTT_CLIENT_DATA_T *state) {
+    mqtt_client_t *client = state->mqtt_client_inst;
+    u32_t ring_len = client->output.put - client->output.get; // Mesma conta do mqtt_ringbuf_len() do lwIP
+    if (ring_len > 0xFFFF) {
+        ring_len += MQTT_OUTPUT_RINGBUF_SIZE;
+    }
+    if (ring_len > mqtt_output_stats.ring_max) {
+        mqtt_output_stats.ring_max = ring_len;
+    }
+    uint8_t reqs = 0;
+    for (int i = 0; i < MQTT_REQ_MAX_IN_FLIGHT; i++) {
+        if (client->req_list[i].next != &client->req_list[i]) { // Livre quando aponta para si mesma
+            reqs++;
+        }
+    }
+    if (reqs > mqtt_output_stats.req_max) {
+        mqtt_output_stats.req_max = reqs;
+    }
+}
+
+static void memory_budget_report(void) {
+    INFO_printf("Memory budget: lwIP heap=%u (mqtt client %u, out ring %u) memp pools=%u "
+                "(pbuf pool %ux%u, tcp seg %ux%u) payload buf=%u mqtt in=%u total=%u bytes\n",
+                (unsigned)MEMORY_BUDGET_LWIP_HEAP, (unsigned)MEMORY_BUDGET_MQTT_CLIENT,
+                (unsigned)MQTT_OUTPUT_RINGBUF_SIZE, (unsigned)MEMORY_BUDGET_MEMP,
+                (unsigned)PBUF_POOL_SIZE, (unsigned)MEMORY_BUDGET_PBUF_BLOCK,
+                (unsigned)MEMP_NUM_TCP_SEG, (unsigned)MEMORY_BUDGET_TCP_SEG,
+                (unsigned)MEMORY_BUDGET_PAYLOAD, (unsigned)MQTT_INPUT_DATA_LEN, (unsigned)MEMORY_BUDGET_TOTAL);
+}
+
+// Máximos de uso medidos desde o boot
+static void memory_report(void) {
+    INFO_printf("Memory: mqtt out ring max=%u/%u, requests max=%u/%u, ERR_MEM=%u\n",
+                mqtt_output_stats.ring_max, (unsigned)MQTT_OUTPUT_RINGBUF_SIZE,
+                mqtt_output_stats.req_max, (unsigned)MQTT_REQ_MAX_IN_FLIGHT, mqtt_output_stats.mem_errors);
+#if MEM_STATS
+    INFO_printf("Memory: lwIP heap max=%u/%u err=%u\n",
+                (unsigned)lwip_stats.mem.max, (unsigned)MEM_SIZE, (unsigned)lwip_stats.mem.err);
+#endif
+#if MEMP_STATS
+    INFO_printf("Memory: pbuf pool max=%u/%u err=%u, tcp seg max=%u/%u err=%u\n",
+                (unsigned)lwip_stats.memp[MEMP_PBUF_POOL]->max, (unsigned)PBUF_POOL_SIZE,
+                (unsigned)lwip_stats.memp[MEMP_PBUF_POOL]->err,
+                (unsigned)lwip_stats.memp[MEMP_TCP_SEG]->max, (unsigned)MEMP_NUM_TCP_SEG,
+                (unsigned)lwip_stats.memp[MEMP_TCP_SEG]->err);
+#endif
+}
+
 static float read_onboard_pressure(const char unit) {
     adc_select_input(0);
     uint16_t raw_value = adc_read(); // Lê valor ADC (0 a 4095)
@@ -288,7 +619,7 @@ static void control_led(MQTT_CLIENT_DATA_T *state, bool on) {
     if (state->led_state) {
         if (absolute_time_diff_us(last_buzzer_toggle, get_absolute_time()) >= BUZZER_INTERVAL_MS * 1000) {
             buzzer_on = !buzzer_on;
-            pwm_set_gpio_level(BUZZER_PIN, buzzer_on ? (65535 * BUZZER_DUTY_CYCLE / 100) : 0);
+            pwm_set_gpio_level(BUZZER_PIN, buzzer_on ? (buzzer_wrap * BUZZER_DUTY_CYCLE / 100) : 0);
             INFO_printf("Buzzer PWM %s\n", buzzer_on ? "on" : "off");
             last_buzzer_toggle = get_absolute_time();
         }
@@ -303,12 +634,14 @@ static void publish_pressure(MQTT_CLIENT_DATA_T *state) {
     control_led(state, led_on);
     if (fabs(pressure - old_pressure) > 0.1f || old_pressure == -1.0f) {
         old_pressure = pressure;
-        char temp_str[16];
-        snprintf(temp_str, sizeof(temp_str), "%.2f", pressure);
-        INFO_printf("Publishing %s to %s\n", temp_str, pressure_key);
         if (mqtt_client_is_connected(state->mqtt_client_inst)) {
-            mqtt_publish(state->mqtt_client_inst, pressure_key, temp_str, strlen(temp_str), 
-                         MQTT_PUBLISH_QOS, MQTT_PUBLISH_RETAIN, pub_request_cb, state);
+            PAYLOAD_T *payload = payload_begin();
+            payload_append(payload, "%.2f", pressure);
+            INFO_printf("Publishing %s to %s\n", payload->data, pressure_key);
+            err_t err = publish_payload(state, pressure_key, payload, MQTT_PUBLISH_QOS, pub_request_cb);
+            if (err != ERR_OK) {
+                ERROR_printf("Publish to %s failed %d\n", pressure_key, err);
+            }
         } else {
             ERROR_printf("Cannot publish to %s: MQTT client not connected\n", pressure_key);
         }
@@ -330,12 +663,14 @@ static void publish_gas(MQTT_CLIENT_DATA_T *state) {
     control_led(state, led_on);
     if (fabs(gas - old_gas) > 0.1f || old_gas == -1.0f) {
         old_gas = gas;
-        char temp_str[16];
-        snprintf(temp_str, sizeof(temp_str), "%.2f", gas);
-        INFO_printf("Publishing gas: %s to %s\n", temp_str, gas_key);
         if (mqtt_client_is_connected(state->mqtt_client_inst)) {
-            mqtt_publish(state->mqtt_client_inst, gas_key, temp_str, strlen(temp_str), 
-                         MQTT_PUBLISH_QOS, MQTT_PUBLISH_RETAIN, pub_request_cb, state);
+            PAYLOAD_T *payload = payload_begin();
+            payload_append(payload, "%.2f", gas);
+            INFO_printf("Publishing gas: %s to %s\n", payload->data, gas_key);
+            err_t err = publish_payload(state, gas_key, payload, MQTT_PUBLISH_QOS, pub_request_cb);
+            if (err != ERR_OK) {
+                ERROR_printf("Publish to %s failed %d\n", gas_key, err);
+            }
         } else {
             ERROR_printf("Cannot publish to %s: MQTT client not connected\n", gas_key);
         }
@@ -385,7 +720,11 @@ static void mqtt_incoming_data_cb(void *arg, const u8_t *data, u16_t len, u8_t f
 #else
     const char *basic_topic = state->topic;
 #endif
-    strncpy(state->data, (const char *)data, len);
+    if (len >= sizeof(state->data)) {
+        ERROR_printf("Incoming message on %s truncated (%u bytes)\n", state->topic, len);
+        len = sizeof(state->data) - 1;
+    }
+    memcpy(state->data, data, len);
     state->data[len] = '\0';
 
     DEBUG_printf("Topic: %s, Message: %s\n", state->topic, state->data);
@@ -398,11 +737,10 @@ static void mqtt_incoming_data_cb(void *arg, const u8_t *data, u16_t len, u8_t f
     } else if (strcmp(basic_topic, "/print") == 0) {
         INFO_printf("%.*s\n", len, state->data);
     } else if (strcmp(basic_topic, "/ping") == 0) {
-        char buf[11];
-        snprintf(buf, sizeof(buf), "%u", to_ms_since_boot(get_absolute_time()) / 1000);
         if (mqtt_client_is_connected(state->mqtt_client_inst)) {
-            mqtt_publish(state->mqtt_client_inst, full_topic(state, "/uptime"), buf, strlen(buf), 
-                     MQTT_PUBLISH_QOS, MQTT_PUBLISH_RETAIN, pub_request_cb, state);
+            PAYLOAD_T *payload = payload_begin();
+            payload_append(payload, "%u", to_ms_since_boot(get_absolute_time()) / 1000);
+            publish_payload(state, full_topic(state, "/uptime"), payload, MQTT_PUBLISH_QOS, pub_request_cb);
         }
     } else if (strcmp(basic_topic, "/exit") == 0) {
         state->stop_client = true;
@@ -417,15 +755,168 @@ static void mqtt_incoming_publish_cb(void *arg, const char *topic, u32_t tot_len
 
 static void pressure_worker_fn(async_context_t *context, async_at_time_worker_t *worker) {
     MQTT_CLIENT_DATA_T* state = (MQTT_CLIENT_DATA_T*)worker->user_data;
+    power_phase_enter(POWER_PHASE_ACTIVE);
     publish_pressure(state);
+    power_phase_idle(state);
+    power_sample_done();
     async_context_add_at_time_worker_in_ms(cyw43_arch_async_context(), worker, TEMP_WORKER_TIME_S * 1000);
 }
 
 static void gas_worker_fn(async_context_t *context, async_at_time_worker_t *worker) {
     MQTT_CLIENT_DATA_T* state = (MQTT_CLIENT_DATA_T*)worker->user_data;
+    power_phase_enter(POWER_PHASE_ACTIVE);
     publish_gas(state);
+    power_phase_idle(state);
+    async_context_add_at_time_worker_in_ms(context, worker, TEMP_WORKER_TIME_S * 1000);
+}
+
+#if LOW_POWER_MODE
+static void radio_wake(MQTT_CLIENT_DATA_T *state) {
+    if (state->radio_pm != UPLOAD_WIFI_PM) {
+        cyw43_wifi_pm(&cyw43_state, UPLOAD_WIFI_PM);
+        state->radio_pm = UPLOAD_WIFI_PM;
+        DEBUG_printf("Radio awake\n");
+    }
+}
+
+static void radio_sleep(MQTT_CLIENT_DATA_T *state) {
+    if (state->radio_pm != LOW_POWER_WIFI_PM && state->batch_in_flight == 0) {
+        cyw43_wifi_pm(&cyw43_state, LOW_POWER_WIFI_PM);
+        state->radio_pm = LOW_POWER_WIFI_PM;
+        DEBUG_printf("Radio in power save\n");
+    }
+}
+
+static void batch_pub_cb(void *arg, err_t err) {
+    MQTT_CLIENT_DATA_T* state = (MQTT_CLIENT_DATA_T*)arg;
+    pub_request_cb(arg, err);
+    state->batch_in_flight--;
+    if (state->batch_in_flight == 0) {
+        power_phase_enter(POWER_PHASE_ACTIVE);
+        radio_sleep(state);
+        power_phase_idle(state);
+    }
+}
+
+// Envia as amostras acumuladas como "t0;dt,pressão,gás;dt,pressão,gás;..." (dt em ms)
+static void flush_batch(MQTT_CLIENT_DATA_T *state) {
+    if (batch_count == 0) {
+        return;
+    }
+    if (!mqtt_client_is_connected(state->mqtt_client_inst)) {
+        ERROR_printf("Cannot publish batch: MQTT client not connected\n");
+        radio_sleep(state);
+        return;
+    }
+    PAYLOAD_T *payload = payload_begin();
+#if LOW_POWER_BATCH_CODEC
+    int encoded = sample_codec_encode(batch, batch_count, SAMPLE_CHANNELS, (uint8_t *)payload->data,
+                                      sizeof(payload->data));
+    if (encoded < 0) {
+        ERROR_printf("Batch encode failed %d\n", encoded);
+        radio_sleep(state);
+        return;
+    }
+    payload->len = encoded;
+#else
+    payload_append(payload, "%u", batch[0].time_ms);
+    uint32_t last_ms = batch[0].time_ms;
+    for (int i = 0; i < batch_count; i++) {
+        payload_append(payload, ";%u,%.2f,%.2f", batch[i].time_ms - last_ms,
+                       (batch[i].values[SAMPLE_CHANNEL_PRESSURE] / 4095.0f) * 100.0f,
+                       (batch[i].values[SAMPLE_CHANNEL_GAS] / 4095.0f) * 100.0f);
+        last_ms = batch[i].time_ms;
+    }
+    if (payload->overflow) {
+        ERROR_printf("Batch payload truncated\n");
+    }
+#endif
+    uint16_t len = payload->len;
+    radio_wake(state);
+    err_t err = publish_payload(state, full_topic(state, MQTT_BATCH_TOPIC), payload, MQTT_PUBLISH_QOS, batch_pub_cb);
+    if (err == ERR_OK) {
+        state->batch_in_flight++;
+        INFO_printf("Published batch of %d samples (%u bytes), oldest sample age %u ms\n", batch_count, len,
+                    to_ms_since_boot(get_absolute_time()) - batch[0].time_ms);
+        batch_count = 0;
+    } else {
+        ERROR_printf("Batch publish failed %d\n", err);
+        radio_sleep(state);
+    }
+    power_report();
+    memory_report();
+}
+
+// Lê os dois sensores, acumula a amostra e só acorda o rádio para envio em lote ou alarme
+static void sample_worker_fn(async_context_t *context, async_at_time_worker_t *worker) {
+    MQTT_CLIENT_DATA_T* state = (MQTT_CLIENT_DATA_T*)worker->user_data;
+    power_phase_enter(POWER_PHASE_ACTIVE);
+    SAMPLE_T *sample = &batch[batch_count++];
+    sample->time_ms = to_ms_since_boot(get_absolute_time());
+    adc_select_input(0);
+    sample->values[SAMPLE_CHANNEL_PRESSURE] = adc_read();
+    adc_select_input(1);
+    sample->values[SAMPLE_CHANNEL_GAS] = adc_read();
+    float pressure = (sample->values[SAMPLE_CHANNEL_PRESSURE] / 4095.0f) * 100.0f;
+    float gas = (sample->values[SAMPLE_CHANNEL_GAS] / 4095.0f) * 100.0f;
+    DEBUG_printf("Sample: pressure=%.2f%% gas=%.2f%%\n", pressure, gas);
+
+    bool led_on = (pressure > 60.0f) || (gas > 40.0f);
+    if (led_on != state->led_state) {
+        // Alarme: envia imediatamente o estado do LED e as amostras pendentes
+        radio_wake(state);
+        control_led(state, led_on);
+        flush_batch(state);
+    } else {
+        control_led(state, led_on); // Mantém o buzzer intermitente
+        if (batch_count == LOW_POWER_BATCH_SAMPLES) {
+            flush_batch(state);
+        }
+    }
+    if (batch_count == LOW_POWER_BATCH_SAMPLES) {
+        // Falha no envio: descarta a amostra mais antiga para não bloquear a aquisição
+        memmove(&batch[0], &batch[1], sizeof(batch) - sizeof(batch[0]));
+        batch_count--;
+    }
+    power_phase_idle(state);
+    power_stats.samples++;
     async_context_add_at_time_worker_in_ms(context, worker, TEMP_WORKER_TIME_S * 1000);
 }
+#endif
+
+#if MQTT_BENCHMARK
+// Publica rajadas contínuas e mede vazão, erros e máximos de uso de memória
+static void bench_worker_fn(async_context_t *context, async_at_time_worker_t *worker) {
+    MQTT_CLIENT_DATA_T* state = (MQTT_CLIENT_DATA_T*)worker->user_data;
+    static uint32_t seq, sent, failed, bytes;
+    static absolute_time_t report_time;
+    if (is_nil_time(report_time)) {
+        report_time = make_timeout_time_ms(MQTT_BENCH_REPORT_MS);
+    }
+    for (int i = 0; i < MQTT_BENCH_BURST && mqtt_client_is_connected(state->mqtt_client_inst); i++) {
+        PAYLOAD_T *payload = payload_begin();
+        payload_append(payload, "%u", seq++);
+        while (payload->len < MQTT_BENCH_PAYLOAD_LEN && payload_append(payload, ";2000,50.00,50.00")) {
+        }
+        uint16_t len = payload->len;
+        if (publish_payload(state, full_topic(state, MQTT_BENCH_TOPIC), payload, MQTT_BENCH_QOS, NULL) == ERR_OK) {
+            sent++;
+            bytes += len;
+        } else {
+            failed++;
+            break; // Ring ou fila de requisições cheia: espera a próxima rajada
+        }
+    }
+    if (time_reached(report_time)) {
+        INFO_printf("Bench: %u msg/s, %u B/s, %u failed\n", sent * 1000 / MQTT_BENCH_REPORT_MS,
+                    bytes * 1000 / MQTT_BENCH_REPORT_MS, failed);
+        memory_report();
+        sent = failed = bytes = 0;
+        report_time = make_timeout_time_ms(MQTT_BENCH_REPORT_MS);
+    }
+    async_context_add_at_time_worker_in_ms(context, worker, MQTT_BENCH_INTERVAL_MS);
+}
+#endif
 
 static void mqtt_connection_cb(mqtt_client_t *client, void *arg, mqtt_connection_status_t status) {
     MQTT_CLIENT_DATA_T* state = (MQTT_CLIENT_DATA_T*)arg;
@@ -443,15 +934,33 @@ static void mqtt_connection_cb(mqtt_client_t *client, void *arg, mqtt_connection
             mqtt_publish(state->mqtt_client_inst, state->mqtt_client_info.will_topic, "1", 1, 
                          MQTT_WILL_QOS, true, pub_request_cb, state);
         }
+#if LOW_POWER_MODE
+        sample_worker.user_data = state;
+        async_context_add_at_time_worker_in_ms(cyw43_arch_async_context(), &sample_worker, 0);
+        control_led(state, false); // Inicializa LED como desligado
+        radio_sleep(state);
+        power_phase_idle(state);
+#else
         pressure_worker.user_data = state;
         gas_worker.user_data = state;
         async_context_add_at_time_worker_in_ms(cyw43_arch_async_context(), &pressure_worker, 0);
         async_context_add_at_time_worker_in_ms(cyw43_arch_async_context(), &gas_worker, 0);
         control_led(state, false); // Inicializa LED como desligado
+#endif
+#if MQTT_BENCHMARK
+        bench_worker.user_data = state;
+        async_context_add_at_time_worker_in_ms(cyw43_arch_async_context(), &bench_worker, 0);
+#endif
     } else if (status == MQTT_CONNECT_DISCONNECTED) {
         if (!state->connect_done) {
             ERROR_printf("Failed to connect to mqtt server\n");
         }
+#if LOW_POWER_MODE
+        // O lwIP descarta as requisições pendentes sem chamar os callbacks
+        state->batch_in_flight = 0;
+        radio_sleep(state);
+        power_phase_idle(state);
+#endif
     } else {
         ERROR_printf("Unexpected MQTT status: %d\n", status);
     }
@@ -0,0 +1,214 @@
+/* Codec compacto para lotes de amostras (séries temporais)
+ */
+
+#include "sample_codec.h"
+
+#include <stdbool.h>
+
+typedef struct {
+    uint8_t *buf;
+    size_t size;
+    size_t bit;       // Próximo bit a escrever
+    bool overflow;
+} bit_writer_t;
+
+typedef struct {
+    const uint8_t *buf;
+    size_t size;
+    size_t bit;       // Próximo bit a ler
+    bool underflow;
+} bit_reader_t;
+
+static void put_bits(bit_writer_t *w, uint32_t value, int nbits) {
+    if (w->bit + nbits > w->size * 8) {
+        w->overflow = true;
+        return;
+    }
+    for (int i = nbits - 1; i >= 0; i--) {
+        uint8_t mask = 0x80 >> (w->bit & 7);
+        if ((value >> i) & 1) {
+            w->buf[w->bit >> 3] |= mask;
+        } else {
+            w->buf[w->bit >> 3] &= ~mask;
+        }
+        w->bit++;
+    }
+}
+
+static uint32_t get_bits(bit_reader_t *r, int nbits) {
+    if (r->bit + nbits > r->size * 8) {
+        r->underflow = true;
+        return 0;
+    }
+    uint32_t value = 0;
+    for (int i = 0; i < nbits; i++) {
+        value = (value << 1) | ((r->buf[r->bit >> 3] >> (7 - (r->bit & 7))) & 1);
+        r->bit++;
+    }
+    return value;
+}
+
+static int32_t sign_extend(uint32_t value, int nbits) {
+    uint32_t sign = 1u << (nbits - 1);
+    return (int32_t)((value ^ sign) - sign);
+}
+
+static uint32_t zigzag(int32_t value) {
+    return ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+}
+
+static int32_t unzigzag(uint32_t value) {
+    return (int32_t)(value >> 1) ^ -(int32_t)(value & 1);
+}
+
+static int bit_width(uint32_t value) {
+    int width = 0;
+    while (value) {
+        width++;
+        value >>= 1;
+    }
+    return width;
+}
+
+// Delta-of-delta dos timestamps; a aritmética é módulo 2^32 para tolerar o wrap do contador
+static void put_dod(bit_writer_t *w, int32_t dod) {
+    if (dod == 0) {
+        put_bits(w, 0x0, 1);
+    } else if (dod >= -64 && dod <= 63) {
+        put_bits(w, 0x2, 2);
+        put_bits(w, (uint32_t)dod & 0x7F, 7);
+    } else if (dod >= -256 && dod <= 255) {
+        put_bits(w, 0x6, 3);
+        put_bits(w, (uint32_t)dod & 0x1FF, 9);
+    } else if (dod >= -2048 && dod <= 2047) {
+        put_bits(w, 0xE, 4);
+        put_bits(w, (uint32_t)dod & 0xFFF, 12);
+    } else {
+        put_bits(w, 0xF, 4);
+        put_bits(w, (uint32_t)dod, 32);
+    }
+}
+
+static int32_t get_dod(bit_reader_t *r) {
+    if (get_bits(r, 1) == 0) {
+        return 0;
+    }
+    if (get_bits(r, 1) == 0) {
+        return sign_extend(get_bits(r, 7), 7);
+    }
+    if (get_bits(r, 1) == 0) {
+        return sign_extend(get_bits(r, 9), 9);
+    }
+    if (get_bits(r, 1) == 0) {
+        return sign_extend(get_bits(r, 12), 12);
+    }
+    return (int32_t)get_bits(r, 32);
+}
+
+int sample_codec_encode(const codec_sample_t *samples, uint16_t count, uint8_t channels,
+                        uint8_t *out, size_t out_size) {
+    if (!samples || !out || count == 0 || channels == 0 || channels > SAMPLE_CODEC_MAX_CHANNELS) {
+        return SAMPLE_CODEC_ERR_ARG;
+    }
+    if (out_size < SAMPLE_CODEC_HEADER_LEN) {
+        return SAMPLE_CODEC_ERR_SPACE;
+    }
+    out[0] = (SAMPLE_CODEC_VERSION << 4) | channels;
+    out[1] = count & 0xFF;
+    out[2] = count >> 8;
+
+    bit_writer_t w = { .buf = out + SAMPLE_CODEC_HEADER_LEN, .size = out_size - SAMPLE_CODEC_HEADER_LEN };
+    put_bits(&w, samples[0].time_ms, 32);
+    uint32_t last_delta = 0;
+    for (uint16_t i = 1; i < count; i++) {
+        uint32_t delta = samples[i].time_ms - samples[i - 1].time_ms;
+        put_dod(&w, (int32_t)(delta - last_delta));
+        last_delta = delta;
+    }
+
+    for (uint8_t ch = 0; ch < channels; ch++) {
+        // Largura comum a todas as diferenças do canal
+        uint32_t max_zz = 0;
+        for (uint16_t i = 0; i < count; i++) {
+            if (samples[i].values[ch] > SAMPLE_CODEC_VALUE_MAX) {
+                return SAMPLE_CODEC_ERR_ARG;
+            }
+            if (i > 0) {
+                uint32_t zz = zigzag((int32_t)samples[i].values[ch] - samples[i - 1].values[ch]);
+                if (zz > max_zz) {
+                    max_zz = zz;
+                }
+            }
+        }
+        int width = bit_width(max_zz);
+        put_bits(&w, samples[0].values[ch], 12);
+        put_bits(&w, width, 4);
+        if (width == 0) {
+            continue;
+        }
+        for (uint16_t i = 1; i < count; i++) {
+            put_bits(&w, zigzag((int32_t)samples[i].values[ch] - samples[i - 1].values[ch]), width);
+        }
+    }
+
+    if (w.overflow) {
+        return SAMPLE_CODEC_ERR_SPACE;
+    }
+    // Zera os bits de preenchimento do último byte
+    if (w.bit & 7) {
+        put_bits(&w, 0, 8 - (w.bit & 7));
+    }
+    return (int)(SAMPLE_CODEC_HEADER_LEN + w.bit / 8);
+}
+
+int sample_codec_decode(const uint8_t *in, size_t len, codec_sample_t *samples, uint16_t max_samples,
+                        uint8_t *channels) {
+    if (!in || !samples) {
+        return SAMPLE_CODEC_ERR_ARG;
+    }
+    if (len < SAMPLE_CODEC_HEADER_LEN) {
+        return SAMPLE_CODEC_ERR_FORMAT;
+    }
+    if ((in[0] >> 4) != SAMPLE_CODEC_VERSION) {
+        return SAMPLE_CODEC_ERR_VERSION;
+    }
+    uint8_t nch = in[0] & 0x0F;
+    uint16_t count = in[1] | (in[2] << 8);
+    if (nch == 0 || nch > SAMPLE_CODEC_MAX_CHANNELS || count == 0) {
+        return SAMPLE_CODEC_ERR_FORMAT;
+    }
+    if (count > max_samples) {
+        return SAMPLE_CODEC_ERR_SPACE;
+    }
+
+    bit_reader_t r = { .buf = in + SAMPLE_CODEC_HEADER_LEN, .size = len - SAMPLE_CODEC_HEADER_LEN };
+    samples[0].time_ms = get_bits(&r, 32);
+    uint32_t delta = 0;
+    for (uint16_t i = 1; i < count && !r.underflow; i++) {
+        delta += (uint32_t)get_dod(&r);
+        samples[i].time_ms = samples[i - 1].time_ms + delta;
+    }
+
+    for (uint8_t ch = 0; ch < nch && !r.underflow; ch++) {
+        int32_t value = get_bits(&r, 12);
+        int width = get_bits(&r, 4);
+        samples[0].values[ch] = value;
+        for (uint16_t i = 1; i < count; i++) {
+            if (width) {
+                value += unzigzag(get_bits(&r, width));
+            }
+            if (value < 0 || value > SAMPLE_CODEC_VALUE_MAX) {
+                return SAMPLE_CODEC_ERR_FORMAT;
+            }
+            samples[i].values[ch] = value;
+        }
+    }
+
+    if (r.underflow) {
+        return SAMPLE_CODEC_ERR_FORMAT;
+    }
+    if (channels) {
+        *channels = nch;
+    }
+    return count;
+}
@@ -0,0 +1,57 @@
+/* Codec compacto para lotes de amostras (séries temporais)
+ *
+ * Formato do quadro (versão 1), bits gravados do mais para o menos significativo:
+ *   byte 0      versão (4 bits altos) | número de canais (4 bits baixos)
+ *   bytes 1-2   número de amostras (little-endian)
+ *   timestamps  t0 em 32 bits, depois delta-of-delta em ms:
+ *                 '0'                   dod == 0
+ *                 '10'   + 7 bits       dod em [-64, 63]
+ *                 '110'  + 9 bits       dod em [-256, 255]
+ *                 '1110' + 12 bits      dod em [-2048, 2047]
+ *                 '1111' + 32 bits      demais valores
+ *   canais      para cada canal: primeiro valor em 12 bits, largura w em 4 bits
+ *               e as diferenças seguintes em zig-zag com w bits cada
+ *
+ * Não depende do Pico SDK: os mesmos arquivos compilam no firmware e no host.
+ */
+
+#ifndef SAMPLE_CODEC_H
+#define SAMPLE_CODEC_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define SAMPLE_CODEC_VERSION 1
+#ifndef SAMPLE_CODEC_MAX_CHANNELS
+#define SAMPLE_CODEC_MAX_CHANNELS 4
+#endif
+#if SAMPLE_CODEC_MAX_CHANNELS < 1 || SAMPLE_CODEC_MAX_CHANNELS > 15
+#error "SAMPLE_CODEC_MAX_CHANNELS must be 1-15 (4 bits in header byte 0)"
+#endif
+#define SAMPLE_CODEC_VALUE_MAX 0x0FFF  // Valores de 12 bits do ADC
+#define SAMPLE_CODEC_HEADER_LEN 3
+
+// Tamanho máximo de um quadro, para dimensionar buffers em tempo de compilação
+#define SAMPLE_CODEC_MAX_SIZE(count, channels) \
+    (SAMPLE_CODEC_HEADER_LEN + (32 + ((count) - 1) * 36 + (channels) * (12 + 4 + ((count) - 1) * 13) + 7) / 8)
+
+// Códigos de erro (valores negativos retornados por encode/decode)
+#define SAMPLE_CODEC_ERR_ARG     -1  // Parâmetro inválido ou valor fora de 12 bits
+#define SAMPLE_CODEC_ERR_SPACE   -2  // Buffer de saída pequeno demais
+#define SAMPLE_CODEC_ERR_FORMAT  -3  // Quadro truncado ou corrompido
+#define SAMPLE_CODEC_ERR_VERSION -4  // Versão de quadro não suportada
+
+typedef struct {
+    uint32_t time_ms;
+    uint16_t values[SAMPLE_CODEC_MAX_CHANNELS];
+} codec_sample_t;
+
+// Codifica count amostras com channels canais; retorna o tamanho do quadro ou um erro
+int sample_codec_encode(const codec_sample_t *samples, uint16_t count, uint8_t channels,
+                        uint8_t *out, size_t out_size);
+
+// Decodifica um quadro; retorna o número de amostras ou um erro. channels pode ser NULL
+int sample_codec_decode(const uint8_t *in, size_t len, codec_sample_t *samples, uint16_t max_samples,
+                        uint8_t *channels);
+
+#endif
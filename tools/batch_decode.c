@@ -0,0 +1,41 @@
+/* Decodificador de lotes no host
+ *
+ * Lê um quadro binário do tópico /batch na entrada padrão e imprime as amostras em CSV.
+ *
+ * Compilação: cc -I.. -o batch_decode batch_decode.c ../sample_codec.c
+ * Uso:        mosquitto_sub -h 192.168.1.9 -t /batch -C 1 -N | ./batch_decode
+ */
+
+#include <stdio.h>
+
+#include "sample_codec.h"
+
+#define MAX_FRAME_LEN 4096
+#define MAX_SAMPLES 2048
+
+int main(void) {
+    static uint8_t frame[MAX_FRAME_LEN];
+    static codec_sample_t samples[MAX_SAMPLES];
+
+    size_t len = fread(frame, 1, sizeof(frame), stdin);
+    uint8_t channels;
+    int count = sample_codec_decode(frame, len, samples, MAX_SAMPLES, &channels);
+    if (count < 0) {
+        fprintf(stderr, "decode failed %d (%zu bytes)\n", count, len);
+        return 1;
+    }
+
+    printf("time_ms");
+    for (int ch = 0; ch < channels; ch++) {
+        printf(",ch%d", ch);
+    }
+    printf("\n");
+    for (int i = 0; i < count; i++) {
+        printf("%u", (unsigned)samples[i].time_ms);
+        for (int ch = 0; ch < channels; ch++) {
+            printf(",%u", samples[i].values[ch]);
+        }
+        printf("\n");
+    }
+    return 0;
+}
@@ -0,0 +1,255 @@
+/* Testes do codec de lotes no host
+ *
+ * Verifica ida e volta (encode/decode) com quadros aleatórios e casos extremos,
+ * o limite SAMPLE_CODEC_MAX_SIZE, a rejeição de quadros truncados ou corrompidos
+ * e mede a vazão de codificação e decodificação.
+ *
+ * Compilação: cc -O2 -I.. -o codec_test codec_test.c ../sample_codec.c
+ * Uso:        ./codec_test   (retorna 0 se todos os testes passarem)
+ */
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "sample_codec.h"
+
+#define MAX_SAMPLES 1024
+#define ROUND_TRIPS 20000
+#define BENCH_FRAMES 200000
+#define BENCH_SAMPLES 64
+
+static codec_sample_t samples[MAX_SAMPLES];
+static codec_sample_t decoded[MAX_SAMPLES];
+static uint8_t frame[SAMPLE_CODEC_MAX_SIZE(MAX_SAMPLES, SAMPLE_CODEC_MAX_CHANNELS)];
+static int failures;
+
+#define CHECK(cond, ...) do { \
+    if (!(cond)) { \
+        printf("FAIL %s:%d: ", __FILE__, __LINE__); \
+        printf(__VA_ARGS__); \
+        printf("\n"); \
+        failures++; \
+    } \
+} while (0)
+
+// Gerador xorshift32: sequência determinística e igual em qualquer plataforma
+static uint32_t rng_state = 0x12345678;
+
+static uint32_t rng(void) {
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 17;
+    rng_state ^= rng_state << 5;
+    return rng_state;
+}
+
+static int32_t rng_range(int32_t min, int32_t max) {
+    return min + (int32_t)(rng() % (uint32_t)(max - min + 1));
+}
+
+static uint16_t clamp_adc(int32_t value) {
+    return value < 0 ? 0 : value > SAMPLE_CODEC_VALUE_MAX ? SAMPLE_CODEC_VALUE_MAX : (uint16_t)value;
+}
+
+// Codifica, confere o limite de tamanho e decodifica de volta; retorna o tamanho do quadro
+static int round_trip(uint16_t count, uint8_t channels, const char *name) {
+    int len = sample_codec_encode(samples, count, channels, frame, sizeof(frame));
+    CHECK(len > 0, "%s: encode failed %d", name, len);
+    if (len <= 0) {
+        return len;
+    }
+    CHECK(len <= (int)SAMPLE_CODEC_MAX_SIZE(count, channels), "%s: %d bytes > max %d", name, len,
+          (int)SAMPLE_CODEC_MAX_SIZE(count, channels));
+    CHECK(sample_codec_encode(samples, count, channels, frame, len - 1) == SAMPLE_CODEC_ERR_SPACE,
+          "%s: encode into %d bytes did not report ERR_SPACE", name, len - 1);
+    len = sample_codec_encode(samples, count, channels, frame, sizeof(frame));
+
+    uint8_t decoded_channels = 0;
+    memset(decoded, 0, sizeof(decoded[0]) * count);
+    int n = sample_codec_decode(frame, len, decoded, MAX_SAMPLES, &decoded_channels);
+    CHECK(n == count && decoded_channels == channels, "%s: decoded %d samples/%u channels, expected %u/%u",
+          name, n, decoded_channels, count, channels);
+    for (uint16_t i = 0; n == count && i < count; i++) {
+        bool same = samples[i].time_ms == decoded[i].time_ms;
+        for (uint8_t ch = 0; ch < channels; ch++) {
+            same = same && samples[i].values[ch] == decoded[i].values[ch];
+        }
+        if (!same) {
+            CHECK(false, "%s: sample %u differs", name, i);
+            break;
+        }
+    }
+    return len;
+}
+
+static void fill(uint16_t count, uint8_t channels, uint32_t t0, int mode) {
+    uint32_t t = t0;
+    for (uint16_t i = 0; i < count; i++) {
+        switch (mode) {
+        case 0: t += 2000; break;                            // Período fixo
+        case 1: t += 2000 + rng_range(-10, 10); break;       // Jitter pequeno
+        case 2: t += rng(); break;                           // Delta-of-delta de 32 bits
+        default: t += (uint32_t)rng_range(0, 5000); break;   // Intervalos irregulares
+        }
+        samples[i].time_ms = t;
+        for (uint8_t ch = 0; ch < SAMPLE_CODEC_MAX_CHANNELS; ch++) {
+            if (ch >= channels) {
+                samples[i].values[ch] = 0;
+            } else if (mode == 3) {
+                samples[i].values[ch] = rng() & SAMPLE_CODEC_VALUE_MAX;
+            } else {
+                samples[i].values[ch] = clamp_adc((i ? samples[i - 1].values[ch] : 2048) + rng_range(-4, 4));
+            }
+        }
+    }
+}
+
+static void test_random_round_trips(void) {
+    for (int iter = 0; iter < ROUND_TRIPS && failures == 0; iter++) {
+        uint16_t count = rng_range(1, MAX_SAMPLES);
+        uint8_t channels = rng_range(1, SAMPLE_CODEC_MAX_CHANNELS);
+        fill(count, channels, rng(), iter % 4);
+        round_trip(count, channels, "random");
+    }
+}
+
+static void test_edge_cases(void) {
+    // Delta-of-delta no bucket de 32 bits
+    static const uint32_t times[] = { 0, 1, 0x80000001, 0x80000002, 5, 0xFFFFFFFF };
+    for (int i = 0; i < 6; i++) {
+        samples[i].time_ms = times[i];
+        samples[i].values[0] = 100;
+    }
+    round_trip(6, 1, "dod 32-bit");
+
+    // Wrap do contador de ms durante o lote
+    for (int i = 0; i < 8; i++) {
+        samples[i].time_ms = 0xFFFFF000u + i * 2000u;
+        samples[i].values[0] = 2048;
+    }
+    round_trip(8, 1, "time wraparound");
+
+    // 0 e 4095 alternados: diferenças de ±4095 na largura máxima de zig-zag (13 bits)
+    for (int i = 0; i < 16; i++) {
+        samples[i].time_ms = 1000 + i * 2000;
+        for (int ch = 0; ch < SAMPLE_CODEC_MAX_CHANNELS; ch++) {
+            samples[i].values[ch] = ((i + ch) & 1) ? SAMPLE_CODEC_VALUE_MAX : 0;
+        }
+    }
+    round_trip(16, SAMPLE_CODEC_MAX_CHANNELS, "max zig-zag width");
+
+    // Amostra única e valores constantes (largura 0)
+    samples[0].time_ms = 42;
+    samples[0].values[0] = SAMPLE_CODEC_VALUE_MAX;
+    round_trip(1, 1, "single sample");
+    fill(32, 2, 0, 0);
+    for (int i = 0; i < 32; i++) {
+        samples[i].values[0] = samples[i].values[1] = 7;
+    }
+    round_trip(32, 2, "constant values");
+
+    // Parâmetros inválidos
+    samples[0].values[0] = SAMPLE_CODEC_VALUE_MAX + 1;
+    CHECK(sample_codec_encode(samples, 1, 1, frame, sizeof(frame)) == SAMPLE_CODEC_ERR_ARG, "13-bit value accepted");
+    CHECK(sample_codec_encode(samples, 0, 1, frame, sizeof(frame)) == SAMPLE_CODEC_ERR_ARG, "empty frame accepted");
+    CHECK(sample_codec_encode(samples, 1, SAMPLE_CODEC_MAX_CHANNELS + 1, frame, sizeof(frame)) == SAMPLE_CODEC_ERR_ARG,
+          "too many channels accepted");
+}
+
+static void test_bad_frames(void) {
+    for (int iter = 0; iter < 2000 && failures == 0; iter++) {
+        // Até 16 amostras: o quadro nunca tem bits para MAX_SAMPLES - 1 amostras
+        uint16_t count = rng_range(1, 16);
+        uint8_t channels = rng_range(1, 2);
+        fill(count, channels, rng(), iter % 4);
+        int len = sample_codec_encode(samples, count, channels, frame, sizeof(frame));
+
+        // Todo truncamento remove ao menos um bit de dados
+        for (int cut = 0; cut < len; cut++) {
+            int n = sample_codec_decode(frame, cut, decoded, MAX_SAMPLES, NULL);
+            CHECK(n == SAMPLE_CODEC_ERR_FORMAT, "truncated to %d of %d bytes returned %d", cut, len, n);
+        }
+
+        uint8_t saved = frame[0];
+        frame[0] = (uint8_t)((SAMPLE_CODEC_VERSION + 1) << 4) | channels;
+        CHECK(sample_codec_decode(frame, len, decoded, MAX_SAMPLES, NULL) == SAMPLE_CODEC_ERR_VERSION, "bad version");
+        frame[0] = (SAMPLE_CODEC_VERSION << 4) | 0;
+        CHECK(sample_codec_decode(frame, len, decoded, MAX_SAMPLES, NULL) == SAMPLE_CODEC_ERR_FORMAT, "zero channels");
+        frame[0] = (SAMPLE_CODEC_VERSION << 4) | (SAMPLE_CODEC_MAX_CHANNELS + 1);
+        CHECK(sample_codec_decode(frame, len, decoded, MAX_SAMPLES, NULL) == SAMPLE_CODEC_ERR_FORMAT,
+              "too many channels");
+        frame[0] = saved;
+
+        uint8_t count_lo = frame[1], count_hi = frame[2];
+        frame[1] = frame[2] = 0;
+        CHECK(sample_codec_decode(frame, len, decoded, MAX_SAMPLES, NULL) == SAMPLE_CODEC_ERR_FORMAT, "zero samples");
+        // Um número de amostras maior que o quadro comporta esgota os bits
+        frame[1] = (MAX_SAMPLES - 1) & 0xFF;
+        frame[2] = (MAX_SAMPLES - 1) >> 8;
+        CHECK(sample_codec_decode(frame, len, decoded, MAX_SAMPLES, NULL) == SAMPLE_CODEC_ERR_FORMAT,
+              "inflated sample count");
+        frame[1] = count_lo;
+        frame[2] = count_hi;
+
+        // Bits invertidos no corpo: o resultado pode ser válido, mas nunca além do buffer
+        frame[SAMPLE_CODEC_HEADER_LEN + rng() % (len - SAMPLE_CODEC_HEADER_LEN)] ^= 1 << (rng() & 7);
+        int n = sample_codec_decode(frame, len, decoded, MAX_SAMPLES, NULL);
+        CHECK(n == count || n == SAMPLE_CODEC_ERR_FORMAT, "bit flip returned %d", n);
+    }
+}
+
+// Tamanho de um lote de 8 amostras como enviado pelo modo de baixo consumo
+static void report_frame_sizes(void) {
+    for (int i = 0; i < 8; i++) {
+        samples[i].time_ms = 100000 + i * 2000;
+        samples[i].values[0] = 2048;
+        samples[i].values[1] = 1500;
+    }
+    int steady = sample_codec_encode(samples, 8, 2, frame, sizeof(frame));
+    for (int i = 0; i < 8; i++) {
+        samples[i].time_ms = 100000 + i * 2000 + rng_range(-1, 1);
+        samples[i].values[0] = 2048 + rng_range(-2, 2);
+        samples[i].values[1] = 1500 + rng_range(-2, 2);
+    }
+    int noisy = sample_codec_encode(samples, 8, 2, frame, sizeof(frame));
+    printf("8-sample frame: %d bytes steady, %d bytes with +-1 ms jitter and +-2 LSB noise\n", steady, noisy);
+}
+
+static double elapsed_s(clock_t start) {
+    return (double)(clock() - start) / CLOCKS_PER_SEC;
+}
+
+static void report_throughput(void) {
+    fill(BENCH_SAMPLES, 2, 100000, 1);
+    int len = 0;
+    volatile int sink = 0;
+    clock_t start = clock();
+    for (int i = 0; i < BENCH_FRAMES; i++) {
+        len = sample_codec_encode(samples, BENCH_SAMPLES, 2, frame, sizeof(frame));
+        sink += len;
+    }
+    double encode_s = elapsed_s(start);
+    start = clock();
+    for (int i = 0; i < BENCH_FRAMES; i++) {
+        sink += sample_codec_decode(frame, len, decoded, MAX_SAMPLES, NULL);
+    }
+    double decode_s = elapsed_s(start);
+    double total = (double)BENCH_FRAMES * BENCH_SAMPLES;
+    printf("Throughput (%d samples x 2 channels per frame): encode %.1f Msamples/s, decode %.1f Msamples/s\n",
+           BENCH_SAMPLES, total / encode_s / 1e6, total / decode_s / 1e6);
+}
+
+int main(void) {
+    test_random_round_trips();
+    test_edge_cases();
+    test_bad_frames();
+    report_frame_sizes();
+    report_throughput();
+    if (failures) {
+        printf("%d failures\n", failures);
+        return 1;
+    }
+    printf("All codec tests passed\n");
+    return 0;
+}